@@ -11,10 +11,12 @@ MGBA_MENU_DEPENDENCIES = qt5base
 MGBA_MENU_QMAKE_PROFILES = mgba_menu.pro
 
 # ---------------------------------------------------------------------------
-# Install: just drop the binary into /usr/bin on the rootfs
+# Install: drop the binary into /usr/bin on the rootfs, plus the mgba-qt
+# script used to time ROM launches
 # ---------------------------------------------------------------------------
 define MGBA_MENU_INSTALL_TARGET_CMDS
 	$(INSTALL) -D $(@D)/mgba_menu $(TARGET_DIR)/usr/bin/mgba_menu
+	$(INSTALL) -D -m 0644 $(@D)/launch_timer.lua $(TARGET_DIR)/usr/share/mgba_menu/launch_timer.lua
 endef
 
 # Nothing needs to go to the staging dir for sdk/sysroot
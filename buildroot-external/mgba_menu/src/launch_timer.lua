@@ -0,0 +1,31 @@
+-- Loaded by mgba-qt (--script) when mgba_menu is run with MGBA_MENU_MEASURE_LAUNCH=1.
+-- Logs how long it took from launchRom() in the menu to the first emulated
+-- frame, together with how much of the ROM the menu had prefetched.
+
+local launchMs = tonumber(os.getenv("MGBA_MENU_LAUNCH_MS") or "")
+local prefetch = os.getenv("MGBA_MENU_PREFETCH") or "unknown"
+local frameCb
+
+-- /proc/uptime is CLOCK_BOOTTIME, the clock the menu stamped the launch with.
+local function uptimeMs()
+    local f = io.open("/proc/uptime", "r")
+    if not f then return nil end
+    local up = f:read("n")
+    f:close()
+    return up and up * 1000
+end
+
+frameCb = callbacks:add("frame", function()
+    callbacks:remove(frameCb)
+    local now = uptimeMs()
+    if not (launchMs and now) then return end
+
+    local msg = string.format("[launch] First frame %d ms after launchRom() (prefetch: %s)",
+                              math.floor(now - launchMs), prefetch)
+    console:log(msg)
+    local log = io.open("/tmp/mgba_menu.log", "a")
+    if log then
+        log:write(msg, "\n")
+        log:close()
+    end
+end)
@@ -18,10 +18,16 @@
 #include <fcntl.h>
 #include <linux/input.h>
 #include <unistd.h>
+#include <time.h>
 #include <SDL2/SDL.h>
 #include <QImageReader>
 #include <QDebug>
 #include <QMessageBox>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QtConcurrent>
+#include "romlibrary.h"
+#include "romprefetch.h"
 
 bool isRaspberryPi()
 {
@@ -39,6 +45,9 @@ public:
         setWindowTitle("GBA UI Menu");
         setFixedSize(1920, 1080);
 
+        // Before anything that can move focus (updateFocus/updateSubFocus use it).
+        prefetcher_ = new RomPrefetcher(this);
+
         if (SDL_Init(SDL_INIT_GAMECONTROLLER) == 0) {
             if (SDL_NumJoysticks() > 0 && SDL_IsGameController(0)) {
                 SDL_GameController *gc = SDL_GameControllerOpen(0);
@@ -57,6 +66,9 @@ public:
 
         QTimer::singleShot(100, this, [this]() { updateFocus(); });
 
+        verifyWatcher_ = new QFutureWatcher<RomLibrary::Summary>(this);
+        connect(verifyWatcher_, &QFutureWatcher<RomLibrary::Summary>::finished, this, [this] { onVerifyFinished(); });
+
         openEvdevGamepad();
     }
 
@@ -185,6 +197,7 @@ private:
 
     void updateFocus()
     {
+        prefetcher_->setFocusedRom(QString());
         activateWindow();
         for (int i = 0; i < buttons_.size(); ++i) {
             if (i == currentRow_ * cols_ + currentCol_)
@@ -200,6 +213,7 @@ private:
         for (int i = 0; i < subButtons_.size(); ++i) {
             if (i == subFocusIndex_) {
                 subButtons_[i]->setFocus(Qt::OtherFocusReason);
+                prefetcher_->setFocusedRom(subButtons_[i]->property("romPath").toString());
 
                 // --- NEW: Ensure button is visible inside scroll area ---
                 if (romScrollArea_ && romScrollArea_->isVisible()) {
@@ -425,6 +439,18 @@ private:
         fakeBtn->setStyleSheet(defaultBtnStyle);
         fakeBtn->setFocusPolicy(Qt::StrongFocus);
 
+        // Re-entering System while a verify is still hashing: show that one
+        // instead of offering to start a second run over the same index.
+        if (titleText == "System") {
+            if (verifyWatcher_ && verifyWatcher_->isRunning()) {
+                fakeBtn->setText("Verifying ROMs...");
+                fakeBtn->setEnabled(false);
+                verifyBtn_ = fakeBtn;
+            } else {
+                fakeBtn->setText("Verify ROMs");
+            }
+        }
+
         // Customized dummy handler
         connect(fakeBtn, &QPushButton::clicked, this, [this, titleText, fakeBtn] {
             if (titleText == "Play") {
@@ -459,7 +485,7 @@ private:
             }
             else if (titleText == "System") {
                 qDebug() << "[action] System button clicked!";
-                // TODO: Show System Settings
+                startVerify(fakeBtn);
             }
             else if (titleText == "Settings") {
                 qDebug() << "[action] Settings button clicked!";
@@ -578,14 +604,19 @@ private:
         romLayout->setSpacing(10);
 
         QStringList romPaths = findRomFiles();
+        const QHash<QString, RomRecord> romIndex = RomLibrary::loadIndex(); // filled in by System -> verify
 
         for (const QString &romPath : romPaths) {
             QString displayName = QFileInfo(romPath).completeBaseName().replace("_", " "); // prettier name
+            if (romIndex.contains(romPath) && romIndex[romPath].status != RomRecord::Unknown)
+                displayName += QString(" [%1]").arg(RomLibrary::statusText(romIndex[romPath].status));
             auto *btn = new QPushButton(displayName);
             btn->setFixedSize(1000, 100);
             btn->setStyleSheet(defaultBtnStyle);
             btn->setFocusPolicy(Qt::StrongFocus);
 
+            btn->setProperty("romPath", romPath); // picked up by updateSubFocus() for prefetching
+
             connect(btn, &QPushButton::clicked, this, [this, romPath] {
                 launchRom(romPath);
             });
@@ -644,10 +675,51 @@ private:
         return result;
     }
 
+    void startVerify(QPushButton *btn)
+    {
+        verifyBtn_ = btn;
+        btn->setText("Verifying ROMs...");
+        btn->setEnabled(false);
+        if (verifyWatcher_->isRunning()) return;
+
+        // Hashing runs on a worker thread so the gamepad stays responsive.
+        const QStringList romPaths = findRomFiles();
+        verifyWatcher_->setFuture(QtConcurrent::run([romPaths] { return RomLibrary::verifyRoms(romPaths); }));
+    }
+
+    void onVerifyFinished()
+    {
+        const RomLibrary::Summary s = verifyWatcher_->result();
+        if (!verifyBtn_) return;   // page was rebuilt or left; nothing to update
+        if (s.datEntries == 0)
+            verifyBtn_->setText(QString("No No-Intro DAT in /root/nointro_dat (%1 unreadable)").arg(s.unreadable));
+        else
+            verifyBtn_->setText(QString("Verified %1/%2 ROMs (%3 misnamed, %4 bad, %5 unreadable)")
+                                    .arg(s.verified).arg(s.total).arg(s.misnamed).arg(s.badDump).arg(s.unreadable));
+        verifyBtn_->setEnabled(true);
+    }
+
     void launchRom(const QString &romPath)
     {
+        // Start of the launch-time measurement. CLOCK_BOOTTIME is what /proc/uptime
+        // reports, which is all launch_timer.lua can read from inside mgba-qt.
+        struct timespec ts;
+        clock_gettime(CLOCK_BOOTTIME, &ts);
+        const qint64 launchMs = qint64(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+        const QString prefetch = prefetcher_->stateFor(romPath);
+        qDebug() << "[launch]" << romPath << "prefetch:" << prefetch;
+
         if (isRaspberryPi()) {
-            ::execl("/usr/bin/mgba-qt", "mgba-qt", "-b", "/root/gba_bios.bin", romPath.toUtf8().constData(), static_cast<char*>(nullptr));
+            const QByteArray rom = romPath.toUtf8();
+            qputenv("MGBA_MENU_LAUNCH_MS", QByteArray::number(launchMs));
+            qputenv("MGBA_MENU_PREFETCH", prefetch.toUtf8());
+
+            // export MGBA_MENU_MEASURE_LAUNCH=1 in /etc/profile to log launch -> first frame
+            if (qEnvironmentVariableIsSet("MGBA_MENU_MEASURE_LAUNCH") && QFile::exists(launchTimerScript))
+                ::execl("/usr/bin/mgba-qt", "mgba-qt", "-b", "/root/gba_bios.bin", "--script", launchTimerScript,
+                        rom.constData(), static_cast<char*>(nullptr));
+            else
+                ::execl("/usr/bin/mgba-qt", "mgba-qt", "-b", "/root/gba_bios.bin", rom.constData(), static_cast<char*>(nullptr));
             QApplication::exit(1);
         } else {
             QApplication::quit();
@@ -664,6 +736,10 @@ private:
     const int rows_ = 3, cols_ = 3;
     int gamepadFd_ = -1;
     QSocketNotifier *notifier_ = nullptr;
+    RomPrefetcher *prefetcher_ = nullptr;
+    QFutureWatcher<RomLibrary::Summary> *verifyWatcher_ = nullptr;  // one verify at a time
+    QPointer<QPushButton> verifyBtn_;
+    static constexpr const char *launchTimerScript = "/usr/share/mgba_menu/launch_timer.lua";
 
     const QString defaultBtnStyle =
         "QPushButton { background: rgb(100,149,237); color: white; font-size: 24px; border-radius: 8px; }"
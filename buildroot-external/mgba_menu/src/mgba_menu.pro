@@ -1,10 +1,11 @@
 # Fix for: error: QApplication: No such file or directory
 # Solution: add `QT += widgets` (from https://stackoverflow.com/questions/8995399/error-qapplication-no-such-file-or-directory)
 
-QT       += widgets
+QT       += widgets concurrent
 CONFIG   += c++17
 TARGET    = mgba_menu
 TEMPLATE  = app
 LIBS += -lSDL2
 
-SOURCES  += main.cpp
\ No newline at end of file
+SOURCES  += main.cpp romhash.cpp romlibrary.cpp romprefetch.cpp
+HEADERS  += romhash.h romlibrary.h romprefetch.h
\ No newline at end of file
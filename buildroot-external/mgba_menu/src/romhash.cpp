@@ -0,0 +1,551 @@
+// ROM hashing for the library verifier.
+//
+// The Pi 3B+ (Cortex-A53) has the ARMv8 CRC32 instructions, so CRC32 runs at
+// close to SD card speed there. The A53 crypto extension (SHA1) is optional and
+// Broadcom left it out, but the code path is kept for boards that have it. On
+// x86 the same functions use PCLMULQDQ / SHA-NI so results can be checked on
+// the build host. Everything falls back to plain C++ if the CPU has neither.
+
+#include "romhash.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && (defined(__arm__) || defined(__aarch64__))
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#if defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+#include <arm_neon.h>
+#define ROMHASH_ARM_SHA1 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define ROMHASH_X86 1
+#endif
+
+namespace
+{
+
+// 1 MiB per read() keeps the SD card streaming without holding a whole
+// 32 MiB ROM in memory.
+constexpr size_t kReadChunk = 1 << 20;
+
+// ---------------------------------------------------------------------------
+// CPU feature detection
+// ---------------------------------------------------------------------------
+
+// Each detector sits behind the same #if as its only caller, so builds without
+// the matching -march feature don't trip -Wunused-function.
+#if defined(__linux__) && defined(__aarch64__)
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#ifndef HWCAP_SHA1
+#define HWCAP_SHA1 (1 << 5)
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+bool armHasCrc32() { return getauxval(AT_HWCAP) & HWCAP_CRC32; }
+#endif
+#if defined(ROMHASH_ARM_SHA1)
+bool armHasSha1() { return getauxval(AT_HWCAP) & HWCAP_SHA1; }
+#endif
+#elif defined(__linux__) && defined(__arm__)
+#ifndef HWCAP2_CRC32
+#define HWCAP2_CRC32 (1 << 4)
+#endif
+#ifndef HWCAP2_SHA1
+#define HWCAP2_SHA1 (1 << 2)
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+bool armHasCrc32() { return getauxval(AT_HWCAP2) & HWCAP2_CRC32; }
+#endif
+#if defined(ROMHASH_ARM_SHA1)
+bool armHasSha1() { return getauxval(AT_HWCAP2) & HWCAP2_SHA1; }
+#endif
+#endif
+
+#if defined(ROMHASH_X86)
+bool x86HasPclmul()
+{
+    unsigned a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return false;
+    return (c & bit_PCLMUL) && (c & bit_SSE4_1);
+}
+
+bool x86HasShaNi()
+{
+    unsigned a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_1) || !(c & bit_SSSE3)) return false;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return false;
+    return b & (1u << 29);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// CRC32. All variants work on the raw (non-inverted) register.
+// ---------------------------------------------------------------------------
+
+struct Crc32Tables
+{
+    uint32_t t[8][256];
+
+    Crc32Tables()
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : c >> 1;
+            t[0][i] = c;
+        }
+        for (int s = 1; s < 8; ++s)
+            for (int i = 0; i < 256; ++i)
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xff];
+    }
+};
+
+const Crc32Tables &crcTables()
+{
+    static const Crc32Tables tables;
+    return tables;
+}
+
+// Slicing-by-8, little endian only (both targets we care about are).
+uint32_t crc32Generic(uint32_t crc, const uint8_t *p, size_t len)
+{
+    const auto &t = crcTables().t;
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+#if defined(__ARM_FEATURE_CRC32)
+uint32_t crc32Armv8(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32d(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = __crc32b(crc, *p++);
+    return crc;
+}
+#endif
+
+#if defined(ROMHASH_X86)
+// SSE4.2's crc32 instruction is CRC-32C (Castagnoli), which does not match the
+// DAT checksums, so x86 folds with carry-less multiply instead (Intel,
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ").
+__attribute__((target("pclmul,sse4.1"), always_inline)) inline
+__m128i clmulFold(__m128i acc, __m128i next, __m128i k)
+{
+    const __m128i lo = _mm_clmulepi64_si128(acc, k, 0x00);
+    const __m128i hi = _mm_clmulepi64_si128(acc, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(hi, next), lo);
+}
+
+__attribute__((target("pclmul,sse4.1")))
+uint32_t crc32Pclmul(uint32_t crc, const uint8_t *p, size_t len)
+{
+    if (len < 64)
+        return crc32Generic(crc, p, len);
+
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    size_t tail = len & 15;
+    len -= tail;
+
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x00));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x10));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x20));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    p += 64;
+    len -= 64;
+
+    // Fold four lanes in parallel, 64 bytes per iteration.
+    while (len >= 64) {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x30)));
+        p += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one, then any remaining 16-byte blocks.
+    x1 = clmulFold(x1, x2, k3k4);
+    x1 = clmulFold(x1, x3, k3k4);
+    x1 = clmulFold(x1, x4, k3k4);
+    while (len >= 16) {
+        x1 = clmulFold(x1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), k3k4);
+        p += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits.
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits.
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    crc = static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+
+    return crc32Generic(crc, p, tail);
+}
+#endif
+
+using Crc32Fn = uint32_t (*)(uint32_t, const uint8_t *, size_t);
+
+struct Crc32Impl
+{
+    Crc32Fn fn = crc32Generic;
+    const char *name = "generic";
+
+    Crc32Impl()
+    {
+#if defined(__ARM_FEATURE_CRC32) && defined(__linux__)
+        if (armHasCrc32()) { fn = crc32Armv8; name = "armv8"; }
+#elif defined(ROMHASH_X86)
+        if (x86HasPclmul()) { fn = crc32Pclmul; name = "pclmul"; }
+#endif
+    }
+};
+
+const Crc32Impl &crc32Impl()
+{
+    static const Crc32Impl impl;
+    return impl;
+}
+
+// ---------------------------------------------------------------------------
+// SHA-1 block functions. Each consumes `blocks` 64-byte blocks.
+// ---------------------------------------------------------------------------
+
+inline uint32_t rol(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+void sha1Generic(uint32_t state[5], const uint8_t *p, size_t blocks)
+{
+    while (blocks--) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+            w[i] = uint32_t(p[4 * i]) << 24 | uint32_t(p[4 * i + 1]) << 16 | uint32_t(p[4 * i + 2]) << 8 | p[4 * i + 3];
+        for (int i = 16; i < 80; ++i)
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            uint32_t tmp = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = tmp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        p += 64;
+    }
+}
+
+#if defined(ROMHASH_ARM_SHA1)
+void sha1Armv8(uint32_t state[5], const uint8_t *p, size_t blocks)
+{
+    static const uint32_t K[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+    uint32x4_t abcd = vld1q_u32(state);
+    uint32_t e0 = state[4];
+
+    while (blocks--) {
+        const uint32x4_t abcdSaved = abcd;
+        const uint32_t eSaved = e0;
+        uint32x4_t w[4];
+
+        // 20 groups of 4 rounds; w[] is a rolling window of the schedule.
+        for (int g = 0; g < 20; ++g) {
+            uint32x4_t msg;
+            if (g < 4) {
+                msg = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 16 * g)));
+            } else {
+                msg = vsha1su0q_u32(w[g & 3], w[(g + 1) & 3], w[(g + 2) & 3]);
+                msg = vsha1su1q_u32(msg, w[(g + 3) & 3]);
+            }
+            w[g & 3] = msg;
+
+            const uint32x4_t wk = vaddq_u32(msg, vdupq_n_u32(K[g / 5]));
+            const uint32_t e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+            if (g < 5)
+                abcd = vsha1cq_u32(abcd, e0, wk);
+            else if (g >= 10 && g < 15)
+                abcd = vsha1mq_u32(abcd, e0, wk);
+            else
+                abcd = vsha1pq_u32(abcd, e0, wk);
+            e0 = e1;
+        }
+
+        abcd = vaddq_u32(abcd, abcdSaved);
+        e0 += eSaved;
+        p += 64;
+    }
+
+    vst1q_u32(state, abcd);
+    state[4] = e0;
+}
+#endif
+
+#if defined(ROMHASH_X86)
+template <int F>
+__attribute__((target("sha,sse4.1"), always_inline)) inline
+__m128i shaRnds4(__m128i abcd, __m128i e) { return _mm_sha1rnds4_epu32(abcd, e, F); }
+
+__attribute__((target("sha,sse4.1,ssse3")))
+void sha1ShaNi(uint32_t state[5], const uint8_t *p, size_t blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1B);
+    __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+    while (blocks--) {
+        const __m128i abcdSaved = abcd;
+        const __m128i eSaved = e0;
+        __m128i w[4];
+        __m128i prev = abcd;
+
+        for (int g = 0; g < 20; ++g) {
+            __m128i msg;
+            if (g < 4) {
+                msg = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * g)), byteSwap);
+            } else {
+                msg = _mm_sha1msg1_epu32(w[g & 3], w[(g + 1) & 3]);
+                msg = _mm_xor_si128(msg, w[(g + 2) & 3]);
+                msg = _mm_sha1msg2_epu32(msg, w[(g + 3) & 3]);
+            }
+            w[g & 3] = msg;
+
+            const __m128i e = g == 0 ? _mm_add_epi32(e0, msg) : _mm_sha1nexte_epu32(prev, msg);
+            prev = abcd;
+            switch (g / 5) {
+            case 0: abcd = shaRnds4<0>(abcd, e); break;
+            case 1: abcd = shaRnds4<1>(abcd, e); break;
+            case 2: abcd = shaRnds4<2>(abcd, e); break;
+            default: abcd = shaRnds4<3>(abcd, e); break;
+            }
+        }
+
+        e0 = _mm_sha1nexte_epu32(prev, eSaved);
+        abcd = _mm_add_epi32(abcd, abcdSaved);
+        p += 64;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+#endif
+
+using Sha1Fn = void (*)(uint32_t[5], const uint8_t *, size_t);
+
+struct Sha1Impl
+{
+    Sha1Fn fn = sha1Generic;
+    const char *name = "generic";
+
+    Sha1Impl()
+    {
+#if defined(ROMHASH_ARM_SHA1) && defined(__linux__)
+        if (armHasSha1()) { fn = sha1Armv8; name = "armv8"; }
+#elif defined(ROMHASH_X86)
+        if (x86HasShaNi()) { fn = sha1ShaNi; name = "sha-ni"; }
+#endif
+    }
+};
+
+const Sha1Impl &sha1Impl()
+{
+    static const Sha1Impl impl;
+    return impl;
+}
+
+class Sha1
+{
+public:
+    void update(const uint8_t *p, size_t len)
+    {
+        total_ += len;
+        if (bufLen_) {
+            size_t n = std::min(len, sizeof(buf_) - bufLen_);
+            memcpy(buf_ + bufLen_, p, n);
+            bufLen_ += n;
+            p += n;
+            len -= n;
+            if (bufLen_ < sizeof(buf_)) return;
+            sha1Impl().fn(state_, buf_, 1);
+            bufLen_ = 0;
+        }
+        if (len >= 64) {
+            sha1Impl().fn(state_, p, len / 64);
+            p += len & ~size_t(63);
+            len &= 63;
+        }
+        memcpy(buf_, p, len);
+        bufLen_ = len;
+    }
+
+    void finish(uint8_t out[20])
+    {
+        const uint64_t bits = total_ * 8;
+        uint8_t pad[72] = { 0x80 };
+        size_t padLen = (bufLen_ < 56 ? 56 : 120) - bufLen_;
+        for (int i = 0; i < 8; ++i)
+            pad[padLen + i] = uint8_t(bits >> (56 - 8 * i));
+        update(pad, padLen + 8);
+        for (int i = 0; i < 5; ++i) {
+            out[4 * i] = uint8_t(state_[i] >> 24);
+            out[4 * i + 1] = uint8_t(state_[i] >> 16);
+            out[4 * i + 2] = uint8_t(state_[i] >> 8);
+            out[4 * i + 3] = uint8_t(state_[i]);
+        }
+    }
+
+private:
+    uint32_t state_[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint8_t buf_[64];
+    size_t bufLen_ = 0;
+    uint64_t total_ = 0;
+};
+
+// One byte per page: non-zero if that page of the file was already in the page
+// cache. Empty if the file couldn't be mapped.
+std::vector<unsigned char> residentPages(int fd, size_t size, size_t pageSize)
+{
+    std::vector<unsigned char> pages;
+    if (size == 0) return pages;
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) return pages;
+    pages.resize((size + pageSize - 1) / pageSize);
+    if (::mincore(map, size, pages.data()) != 0) pages.clear();
+    ::munmap(map, size);
+    return pages;
+}
+
+// Drop only the pages the scan pulled in, so a library verify doesn't evict a
+// ROM the prefetcher (or anything else) had already cached.
+void dropScannedPages(int fd, const std::vector<unsigned char> &before, size_t pageSize)
+{
+    size_t run = 0;
+    for (size_t i = 0; i <= before.size(); ++i) {
+        if (i < before.size() && !(before[i] & 1)) continue;
+        if (i > run)
+            posix_fadvise(fd, off_t(run * pageSize), off_t((i - run) * pageSize), POSIX_FADV_DONTNEED);
+        run = i + 1;
+    }
+}
+
+} // namespace
+
+bool RomHash::hashFile(const char *path, RomDigest &out)
+{
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> cachedBefore;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        cachedBefore = residentPages(fd, size_t(st.st_size), pageSize);
+
+    // Tell the kernel to read ahead aggressively; we only ever go forwards.
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    std::vector<uint8_t> buf(kReadChunk);
+    uint32_t crc = ~0u;
+    uint64_t size = 0;
+    Sha1 sha;
+    const Crc32Fn crcFn = crc32Impl().fn;
+    bool ok = true;
+
+    for (;;) {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        if (n == 0) break;
+        crc = crcFn(crc, buf.data(), size_t(n));
+        sha.update(buf.data(), size_t(n));
+        size += uint64_t(n);
+    }
+
+    // A full library scan shouldn't push everything else out of the page cache.
+    // If residency couldn't be checked, leave the cache alone rather than guess.
+    dropScannedPages(fd, cachedBefore, pageSize);
+    ::close(fd);
+    if (!ok) return false;
+
+    out.size = size;
+    out.crc32 = ~crc;
+    sha.finish(out.sha1);
+    return true;
+}
+
+const char *RomHash::backendName()
+{
+    static const std::string name = std::string("crc32=") + crc32Impl().name + " sha1=" + sha1Impl().name;
+    return name.c_str();
+}
@@ -0,0 +1,25 @@
+#ifndef ROMHASH_H
+#define ROMHASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC32 (the IEEE polynomial No-Intro uses) and SHA-1 of a ROM, computed in a
+// single streaming pass over the file.
+struct RomDigest
+{
+    uint64_t size = 0;
+    uint32_t crc32 = 0;
+    uint8_t sha1[20] = {};
+};
+
+namespace RomHash
+{
+// Reads the file in large chunks and fills in `out`. Returns false on I/O error.
+bool hashFile(const char *path, RomDigest &out);
+
+// Which code paths were picked for this CPU, e.g. "crc32=armv8 sha1=generic".
+const char *backendName();
+}
+
+#endif // ROMHASH_H
@@ -0,0 +1,223 @@
+#include "romlibrary.h"
+#include "romhash.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMultiHash>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+
+namespace
+{
+
+const QString kIndexPath = "/root/mgba_rom_files/.rom_index.json";
+const QString kDatDir = "/root/nointro_dat";
+
+struct DatRom
+{
+    QString name;
+    qint64 size = -1;
+    QString sha1;
+};
+
+struct Dat
+{
+    QMultiHash<QString, DatRom> byCrc;
+    QHash<QString, DatRom> byName;
+};
+
+// No-Intro DATs are Logiqx XML; all we need are the <rom .../> elements.
+Dat loadDat()
+{
+    Dat dat;
+    QDir dir(kDatDir);
+    QFileInfoList files = dir.entryInfoList(QStringList() << "*.dat", QDir::Files, QDir::Name);
+    if (files.isEmpty()) {
+        qDebug() << "[verify] No DAT found in" << kDatDir;
+        return dat;
+    }
+
+    QFile f(files.first().absoluteFilePath());
+    if (!f.open(QIODevice::ReadOnly)) return dat;
+
+    QXmlStreamReader xml(&f);
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement || xml.name() != QLatin1String("rom"))
+            continue;
+        const QXmlStreamAttributes attrs = xml.attributes();
+        DatRom rom;
+        rom.name = attrs.value("name").toString();
+        rom.size = attrs.value("size").toLongLong();
+        rom.sha1 = attrs.value("sha1").toString().toLower();
+        const QString crc = attrs.value("crc").toString().toLower();
+        if (!crc.isEmpty()) dat.byCrc.insert(crc, rom);
+        dat.byName.insert(rom.name, rom);
+    }
+    if (xml.hasError()) {
+        // A half-read DAT would flag good dumps as unknown; treat it as missing.
+        qDebug() << "[verify] DAT parse error:" << xml.errorString();
+        return Dat();
+    }
+
+    qDebug() << "[verify] Loaded" << dat.byName.size() << "entries from" << f.fileName();
+    return dat;
+}
+
+void match(const Dat &dat, const QString &fileName, RomRecord &rec)
+{
+    rec.status = RomRecord::Unknown;
+    rec.datName.clear();
+
+    for (auto it = dat.byCrc.constFind(rec.crc32); it != dat.byCrc.constEnd() && it.key() == rec.crc32; ++it) {
+        const DatRom &rom = it.value();
+        if (rom.size != rec.size) continue;
+        if (!rom.sha1.isEmpty() && rom.sha1 != rec.sha1) continue;
+        rec.datName = rom.name;
+        rec.status = rom.name == fileName ? RomRecord::Verified : RomRecord::Misnamed;
+        return;
+    }
+
+    // Named like a known dump but the contents differ.
+    if (dat.byName.contains(fileName)) {
+        rec.datName = fileName;
+        rec.status = RomRecord::BadDump;
+    }
+}
+
+QJsonObject toJson(const RomRecord &rec)
+{
+    QJsonObject o;
+    o["size"] = rec.size;
+    o["mtime"] = rec.mtime;
+    o["crc32"] = rec.crc32;
+    o["sha1"] = rec.sha1;
+    o["status"] = int(rec.status);
+    o["datName"] = rec.datName;
+    return o;
+}
+
+RomRecord fromJson(const QJsonObject &o)
+{
+    RomRecord rec;
+    rec.size = qint64(o["size"].toDouble(-1));
+    rec.mtime = qint64(o["mtime"].toDouble());
+    rec.crc32 = o["crc32"].toString();
+    rec.sha1 = o["sha1"].toString();
+    rec.status = RomRecord::Status(o["status"].toInt());
+    rec.datName = o["datName"].toString();
+    return rec;
+}
+
+bool saveIndex(const QHash<QString, RomRecord> &index)
+{
+    QJsonObject roms;
+    for (auto it = index.constBegin(); it != index.constEnd(); ++it)
+        roms[it.key()] = toJson(it.value());
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["roms"] = roms;
+
+    // QSaveFile so a power cut mid-write can't leave a truncated index.
+    QSaveFile f(kIndexPath);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return f.commit();
+}
+
+} // namespace
+
+QHash<QString, RomRecord> RomLibrary::loadIndex()
+{
+    QHash<QString, RomRecord> index;
+    QFile f(kIndexPath);
+    if (!f.open(QIODevice::ReadOnly)) return index;
+
+    const QJsonObject roms = QJsonDocument::fromJson(f.readAll()).object()["roms"].toObject();
+    for (auto it = roms.constBegin(); it != roms.constEnd(); ++it)
+        index.insert(it.key(), fromJson(it.value().toObject()));
+    return index;
+}
+
+RomLibrary::Summary RomLibrary::verifyRoms(const QStringList &romPaths)
+{
+    Summary summary;
+    QElapsedTimer timer;
+    timer.start();
+
+    const QHash<QString, RomRecord> oldIndex = loadIndex();
+    QHash<QString, RomRecord> index;
+    const Dat dat = loadDat();
+    summary.datEntries = dat.byName.size();
+
+    qDebug() << "[verify] Hash backend:" << RomHash::backendName();
+
+    for (const QString &path : romPaths) {
+        const QFileInfo info(path);
+        if (!info.isFile()) continue;
+
+        RomRecord rec = oldIndex.value(path);
+        const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+        if (rec.size != info.size() || rec.mtime != mtime || rec.sha1.isEmpty() || rec.status == RomRecord::Unreadable) {
+            RomDigest digest;
+            if (!RomHash::hashFile(QFile::encodeName(path).constData(), digest)) {
+                // A file the SD card can't read back is exactly what we're here
+                // to catch: keep its last known hashes, but flag it.
+                qDebug() << "[verify] Failed to read" << path;
+                rec.status = RomRecord::Unreadable;
+                index.insert(path, rec);
+                ++summary.total;
+                ++summary.unreadable;
+                continue;
+            }
+            rec.size = qint64(digest.size);
+            rec.mtime = mtime;
+            rec.crc32 = QString("%1").arg(digest.crc32, 8, 16, QChar('0'));
+            rec.sha1 = QString::fromLatin1(QByteArray(reinterpret_cast<const char *>(digest.sha1), sizeof(digest.sha1)).toHex());
+            rec.status = RomRecord::Unknown;   // contents changed, old match no longer applies
+            rec.datName.clear();
+            ++summary.rehashed;
+        }
+
+        // Without a DAT there is nothing to match against, so keep whatever the
+        // last run with one decided.
+        if (summary.datEntries > 0)
+            match(dat, info.fileName(), rec);
+        index.insert(path, rec);
+
+        ++summary.total;
+        switch (rec.status) {
+        case RomRecord::Verified: ++summary.verified; break;
+        case RomRecord::Misnamed: ++summary.misnamed; break;
+        case RomRecord::BadDump: ++summary.badDump; break;
+        case RomRecord::Unknown: ++summary.unknown; break;
+        case RomRecord::Unreadable: ++summary.unreadable; break;
+        }
+        qDebug() << "[verify]" << path << rec.crc32 << statusText(rec.status) << rec.datName;
+    }
+
+    if (!saveIndex(index))
+        qDebug() << "[verify] Could not write" << kIndexPath;
+
+    qDebug() << "[verify] Done:" << summary.total << "ROMs," << summary.rehashed << "rehashed in"
+             << timer.elapsed() << "ms";
+    return summary;
+}
+
+QString RomLibrary::statusText(RomRecord::Status status)
+{
+    switch (status) {
+    case RomRecord::Verified: return "verified";
+    case RomRecord::Misnamed: return "misnamed";
+    case RomRecord::BadDump: return "bad dump";
+    case RomRecord::Unreadable: return "unreadable";
+    case RomRecord::Unknown: break;
+    }
+    return "unknown";
+}
@@ -0,0 +1,47 @@
+#ifndef ROMLIBRARY_H
+#define ROMLIBRARY_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// One entry of the library index (/root/mgba_rom_files/.rom_index.json).
+// size + mtime are what we compare to decide whether a file needs rehashing.
+struct RomRecord
+{
+    enum Status { Unknown, Verified, Misnamed, BadDump, Unreadable };  // stored as int, append only
+
+    qint64 size = -1;
+    qint64 mtime = 0;
+    QString crc32;     // 8 lowercase hex digits, as in No-Intro DATs
+    QString sha1;      // 40 lowercase hex digits
+    Status status = Unknown;
+    QString datName;   // matching No-Intro file name, if any
+};
+
+namespace RomLibrary
+{
+struct Summary
+{
+    int total = 0;
+    int verified = 0;
+    int misnamed = 0;
+    int badDump = 0;
+    int unknown = 0;
+    int unreadable = 0;  // I/O error while hashing; old record kept, tagged unreadable
+    int rehashed = 0;
+    int datEntries = 0;  // 0 = no usable DAT, statuses are from the cached index
+};
+
+QHash<QString, RomRecord> loadIndex();
+
+// Hashes any ROM whose size/mtime changed since the last run, matches every
+// ROM against the first *.dat in /root/nointro_dat and writes the index back.
+// If there is no usable DAT, previously cached statuses are left as they were.
+// Blocking; call it from a worker thread.
+Summary verifyRoms(const QStringList &romPaths);
+
+QString statusText(RomRecord::Status status);
+}
+
+#endif // ROMLIBRARY_H
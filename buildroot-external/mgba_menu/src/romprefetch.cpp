@@ -0,0 +1,152 @@
+#include "romprefetch.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <atomic>
+#include <cerrno>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+
+// How long focus has to stay on a title before we start reading it. Scrolling
+// through the list with the d-pad shouldn't kick off a read per button.
+constexpr int kDwellMs = 300;
+
+// readahead()/WILLNEED only queue I/O, return straight away and are clamped to
+// the device's read-ahead window, so they can't tell us when a ROM is loaded or
+// give us anything to cancel. Plain pread() into a small reused buffer does:
+// each step has really landed in the page cache before we check for
+// cancellation, and 256 KiB is about one SD read-ahead window.
+constexpr qint64 kStep = 256 << 10;
+
+// Never let a prefetch take more than half of what the kernel says is free;
+// mgba-qt still has to start up after us.
+qint64 prefetchBudget()
+{
+    QFile f("/proc/meminfo");
+    if (!f.open(QIODevice::ReadOnly)) return 0;
+    while (!f.atEnd()) {
+        const QByteArray line = f.readLine();
+        if (line.startsWith("MemAvailable:"))
+            return line.mid(13).trimmed().split(' ').first().toLongLong() * 1024 / 2;
+    }
+    return 0;
+}
+
+// How many bytes of the file are actually in the page cache right now. Whatever
+// the prefetch read may since have been evicted (memory pressure, or a
+// System -> verify run dropping pages it read).
+qint64 residentBytes(const QString &path, qint64 size)
+{
+    if (size <= 0) return 0;
+    int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    qint64 resident = 0;
+    void *map = ::mmap(nullptr, size_t(size), PROT_READ, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+        const qint64 pageSize = sysconf(_SC_PAGESIZE);
+        std::vector<unsigned char> pages(size_t((size + pageSize - 1) / pageSize));
+        if (::mincore(map, size_t(size), pages.data()) == 0) {
+            for (unsigned char page : pages)
+                if (page & 1) resident += pageSize;
+        }
+        ::munmap(map, size_t(size));
+    }
+    ::close(fd);
+    return qMin(resident, size);
+}
+
+} // namespace
+
+struct RomPrefetcher::Job
+{
+    QString path;
+    qint64 target = 0;
+    std::atomic<bool> cancelled { false };
+    std::atomic<qint64> done { 0 };
+};
+
+void RomPrefetcher::runPrefetch(const std::shared_ptr<Job> &job)
+{
+    int fd = ::open(QFile::encodeName(job->path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    posix_fadvise(fd, 0, job->target, POSIX_FADV_SEQUENTIAL);
+
+    std::vector<char> buf(size_t(kStep));
+    qint64 off = 0;
+    while (off < job->target && !job->cancelled) {
+        const ssize_t n = ::pread(fd, buf.data(), size_t(qMin(kStep, job->target - off)), off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        off += n;
+        job->done = off;   // only counts bytes that have actually been read
+    }
+    ::close(fd);
+}
+
+RomPrefetcher::RomPrefetcher(QObject *parent)
+    : QObject(parent)
+{
+    dwell_.setSingleShot(true);
+    dwell_.setInterval(kDwellMs);
+    connect(&dwell_, &QTimer::timeout, this, [this] { start(); });
+}
+
+RomPrefetcher::~RomPrefetcher()
+{
+    cancel();
+}
+
+void RomPrefetcher::setFocusedRom(const QString &romPath)
+{
+    if (romPath == focusedPath_) return;
+    focusedPath_ = romPath;
+    cancel();
+    if (!romPath.isEmpty()) dwell_.start();
+}
+
+void RomPrefetcher::cancel()
+{
+    dwell_.stop();
+    if (job_ && job_->done < job_->target) {
+        job_->cancelled = true;
+        qDebug() << "[prefetch] Cancelled" << job_->path << "at" << (job_->done >> 20) << "MiB";
+    }
+}
+
+void RomPrefetcher::start()
+{
+    const qint64 size = QFileInfo(focusedPath_).size();
+    if (size <= 0) return;
+
+    // No "already done" shortcut: earlier pages may have been evicted since, and
+    // re-reading pages that are still cached is only a copy out of memory.
+    auto job = std::make_shared<Job>();
+    job->path = focusedPath_;
+    job->target = qMin(size, prefetchBudget());
+    if (job->target <= 0) {
+        qDebug() << "[prefetch] Skipping" << focusedPath_ << "- not enough free memory";
+        return;
+    }
+
+    qDebug() << "[prefetch] Reading" << job->path << (job->target >> 20) << "MiB";
+    job_ = job;
+    QtConcurrent::run([job] { runPrefetch(job); });
+}
+
+QString RomPrefetcher::stateFor(const QString &romPath) const
+{
+    const qint64 size = QFileInfo(romPath).size();
+    const qint64 resident = residentBytes(romPath, size);
+    if (resident <= 0) return "miss";
+    if (resident >= size) return "hit";
+    return QString("partial %1/%2 MiB").arg(resident >> 20).arg(size >> 20);
+}
@@ -0,0 +1,38 @@
+#ifndef ROMPREFETCH_H
+#define ROMPREFETCH_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <memory>
+
+// Pulls the focused ROM into the page cache while the user is still in the
+// menu, so mgba-qt doesn't have to read it cold from the SD card on launch.
+// A prefetch only starts once focus has rested on a title for a moment and is
+// cancelled as soon as focus moves on.
+class RomPrefetcher : public QObject
+{
+public:
+    explicit RomPrefetcher(QObject *parent = nullptr);
+    ~RomPrefetcher() override;
+
+    // Empty path = focus is on something that isn't a ROM.
+    void setFocusedRom(const QString &romPath);
+    void cancel();
+
+    // "hit", "partial N/M MiB" or "miss" for the launch log, from what is
+    // resident in the page cache right now (mincore), not what we requested.
+    QString stateFor(const QString &romPath) const;
+
+private:
+    struct Job;
+
+    void start();
+    static void runPrefetch(const std::shared_ptr<Job> &job);
+
+    QTimer dwell_;
+    QString focusedPath_;
+    std::shared_ptr<Job> job_;
+};
+
+#endif // ROMPREFETCH_H